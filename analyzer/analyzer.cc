@@ -0,0 +1,218 @@
+#include "analyzer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+const std::array<const char *, Memory::Snapshot::kTypesAll> kTypeNames{
+    "char", "int", "double", "other"};
+
+struct Usage {
+  std::size_t used{0};
+  std::size_t free{0};
+  std::size_t quarantined{0};
+  std::size_t overhead{0};
+};
+
+std::size_t Bucket(std::uint64_t size) {
+  std::size_t bucket = 0;
+  while (size >>= 1) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+// Quarantined blocks hold freed memory, so only kUsed counts as used.
+bool Used(const Memory::Snapshot::Record &record) {
+  return record.used == Memory::Snapshot::kUsed;
+}
+
+// Unknown states of a corrupt record are treated as quarantined: the memory
+// is neither handed out nor available.
+std::size_t State(const Memory::Snapshot::Record &record) {
+  return std::min<std::size_t>(record.used, Memory::Snapshot::kQuarantined);
+}
+
+}  // namespace
+
+Analyzer::Analyzer(std::size_t cells) : m_cells(cells ? cells : 1U) {}
+
+[[nodiscard]] bool Analyzer::Load(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) return false;
+
+  std::vector<char> buffer(static_cast<std::size_t>(file.tellg()));
+  file.seekg(0);
+  if (!file.read(buffer.data(), buffer.size()) ||
+      buffer.size() < sizeof(m_header)) {
+    return false;
+  }
+
+  std::memcpy(&m_header, buffer.data(), sizeof(m_header));
+  // The block count comes from the file, so compare it against the payload
+  // instead of multiplying it, which could overflow on a corrupt snapshot.
+  const std::size_t payload = buffer.size() - sizeof(m_header);
+  if (std::memcmp(m_header.magic, Memory::Snapshot::MAGIC,
+                  sizeof(m_header.magic)) ||
+      payload % sizeof(Memory::Snapshot::Record) ||
+      m_header.blocks != payload / sizeof(Memory::Snapshot::Record)) {
+    return false;
+  }
+
+  m_records.resize(m_header.blocks);
+  std::memcpy(m_records.data(), buffer.data() + sizeof(m_header),
+              m_records.size() * sizeof(Memory::Snapshot::Record));
+  return true;
+}
+
+void Analyzer::Summary(std::ostream &out) const {
+  std::size_t used = 0, vacant = 0, held = 0, largest = 0;
+  std::array<std::size_t, 3> blocks{};
+  for (const auto &record : m_records) {
+    ++blocks[State(record)];
+    if (Used(record)) {
+      used += record.size;
+    } else if (record.used == Memory::Snapshot::kFree) {
+      vacant += record.size;
+      largest = std::max<std::size_t>(largest, record.size);
+    } else {
+      held += record.size;
+    }
+  }
+
+  out << "Heap size:       " << m_header.heap_size << '\n'
+      << "Blocks:          " << m_records.size() << " ("
+      << blocks[Memory::Snapshot::kUsed] << " used, "
+      << blocks[Memory::Snapshot::kFree] << " free";
+  if (blocks[Memory::Snapshot::kQuarantined]) {
+    out << ", " << blocks[Memory::Snapshot::kQuarantined] << " quarantined";
+  }
+  out << ")\n"
+      << "Used bytes:      " << used << '\n'
+      << "Free bytes:      " << vacant << '\n';
+  if (held) {
+    out << "Quarantined:     " << held << '\n';
+  }
+  out << "Header overhead: " << m_records.size() * m_header.header_size << '\n'
+      << "Largest free:    " << largest << '\n'
+      << "Fragmentation:   " << std::fixed << std::setprecision(2)
+      << (vacant ? 100.0 * (vacant - largest) / vacant : 0.0) << "%\n";
+}
+
+void Analyzer::FragmentationMap(std::ostream &out) const {
+  if (!m_header.heap_size) return;
+
+  const std::size_t span = (m_header.heap_size + m_cells - 1) / m_cells;
+  std::vector<Usage> cells((m_header.heap_size + span - 1) / span);
+
+  auto account = [&](std::size_t begin, std::size_t end,
+                     std::size_t Usage::*field) {
+    end = std::min<std::size_t>(end, m_header.heap_size);
+    while (begin < end) {
+      const std::size_t cell = begin / span;
+      const std::size_t stop = std::min(end, (cell + 1) * span);
+      cells[cell].*field += stop - begin;
+      begin = stop;
+    }
+  };
+
+  for (const auto &record : m_records) {
+    const std::size_t payload = record.offset + m_header.header_size;
+    account(record.offset, payload, &Usage::overhead);
+    const std::array<std::size_t Usage::*, 3> fields{
+        &Usage::free, &Usage::used, &Usage::quarantined};
+    account(payload, payload + record.size, fields[State(record)]);
+  }
+
+  // Quarantined memory cannot be reused, so it is never drawn as free.
+  out << "Fragmentation map (" << span
+      << " bytes per cell, '#' used, '+' mostly used, '-' mostly free, "
+         "'.' free, 'q' mostly quarantined):\n";
+  for (std::size_t row = 0; row < cells.size(); row += kCellsPerRow) {
+    out << "  0x" << std::hex << std::setw(10) << std::setfill('0')
+        << row * span << std::dec << std::setfill(' ') << ' ';
+    for (std::size_t i = row; i < std::min(cells.size(), row + kCellsPerRow);
+         ++i) {
+      const Usage &cell = cells[i];
+      const std::size_t busy = cell.used + cell.overhead + cell.quarantined;
+      if (cell.quarantined > cell.used + cell.overhead &&
+          cell.quarantined >= cell.free) {
+        out << 'q';
+      } else if (!cell.free) {
+        out << '#';
+      } else if (!busy) {
+        out << '.';
+      } else {
+        out << (busy >= cell.free ? '+' : '-');
+      }
+    }
+    out << '\n';
+  }
+}
+
+void Analyzer::SizeHistogram(std::ostream &out) const {
+  // Columns hold the block count and bytes of every state, in the order
+  // used, free, quarantined.
+  std::vector<std::array<std::size_t, 6>> buckets;
+  bool quarantined = false;
+  for (const auto &record : m_records) {
+    const std::size_t bucket = Bucket(record.size);
+    if (buckets.size() <= bucket) buckets.resize(bucket + 1);
+    const std::size_t state = State(record);
+    const std::size_t column = state == Memory::Snapshot::kUsed   ? 0
+                               : state == Memory::Snapshot::kFree ? 2
+                                                                  : 4;
+    buckets[bucket][column] += 1;
+    buckets[bucket][column + 1] += record.size;
+    quarantined |= column == 4;
+  }
+
+  out << "Size histogram:\n"
+      << "  " << std::setw(26) << "size range" << std::setw(12) << "used"
+      << std::setw(16) << "used bytes" << std::setw(12) << "free"
+      << std::setw(16) << "free bytes";
+  if (quarantined) {
+    out << std::setw(13) << "quarantined" << std::setw(18)
+        << "quarantined bytes";
+  }
+  out << '\n';
+  for (std::size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+    const auto &row = buckets[bucket];
+    if (!row[0] && !row[2] && !row[4]) continue;
+    const std::uint64_t low = bucket ? 1ULL << bucket : 0;
+    const std::uint64_t high = 1ULL << (bucket + 1);
+    out << "  [" << std::setw(11) << low << ", " << std::setw(11) << high
+        << ")" << std::setw(12) << row[0] << std::setw(16) << row[1]
+        << std::setw(12) << row[2] << std::setw(16) << row[3];
+    if (quarantined) {
+      out << std::setw(13) << row[4] << std::setw(18) << row[5];
+    }
+    out << '\n';
+  }
+}
+
+void Analyzer::TypeBreakdown(std::ostream &out) const {
+  std::array<std::size_t, Memory::Snapshot::kTypesAll> counts{}, bytes{};
+  std::size_t total = 0;
+  for (const auto &record : m_records) {
+    if (!Used(record)) continue;
+    const std::size_t type =
+        std::min<std::size_t>(record.type, Memory::Snapshot::kOther);
+    ++counts[type];
+    bytes[type] += record.size;
+    total += record.size;
+  }
+
+  out << "Type breakdown of used blocks:\n";
+  for (std::size_t type = 0; type < kTypeNames.size(); ++type) {
+    if (!counts[type]) continue;
+    out << "  " << std::setw(8) << kTypeNames[type] << std::setw(12)
+        << counts[type] << " blocks" << std::setw(16) << bytes[type]
+        << " bytes" << std::setw(10) << std::fixed << std::setprecision(2)
+        << 100.0 * bytes[type] / total << "%\n";
+  }
+}
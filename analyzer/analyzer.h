@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#include "snapshot.h"
+
+class Analyzer final {
+ public:
+  explicit Analyzer(std::size_t cells = 512U);
+  explicit Analyzer(const Analyzer &other) = delete;
+  explicit Analyzer(Analyzer &&other) = delete;
+  Analyzer &operator=(const Analyzer &other) = delete;
+  Analyzer &operator=(Analyzer &&other) = delete;
+  ~Analyzer() = default;
+
+  [[nodiscard]] bool Load(const std::filesystem::path &path);
+
+  void Summary(std::ostream &out) const;
+  void FragmentationMap(std::ostream &out) const;
+  void SizeHistogram(std::ostream &out) const;
+  void TypeBreakdown(std::ostream &out) const;
+
+ private:
+  static constexpr std::size_t kCellsPerRow = 64U;
+
+  std::size_t m_cells;
+  Memory::Snapshot::FileHeader m_header{};
+  std::vector<Memory::Snapshot::Record> m_records;
+};
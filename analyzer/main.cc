@@ -0,0 +1,48 @@
+#include <iostream>
+#include <string>
+
+#include "analyzer.h"
+
+namespace {
+
+int Usage(const char *program) {
+  std::cerr << "Usage: " << program << " <snapshot> [cells]\n";
+  return EXIT_FAILURE;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    return Usage(argv[0]);
+  }
+
+  std::size_t cells = 512U;
+  if (argc == 3) {
+    try {
+      std::size_t parsed = 0;
+      const std::string argument(argv[2]);
+      cells = std::stoull(argument, &parsed);
+      if (parsed != argument.size() || argument.front() == '-') {
+        return Usage(argv[0]);
+      }
+    } catch (const std::exception &) {
+      return Usage(argv[0]);
+    }
+  }
+
+  Analyzer analyzer(cells);
+  if (!analyzer.Load(argv[1])) {
+    std::cerr << "Cannot read heap snapshot " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+
+  analyzer.Summary(std::cout);
+  std::cout << '\n';
+  analyzer.FragmentationMap(std::cout);
+  std::cout << '\n';
+  analyzer.SizeHistogram(std::cout);
+  std::cout << '\n';
+  analyzer.TypeBreakdown(std::cout);
+  return EXIT_SUCCESS;
+}
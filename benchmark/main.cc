@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "memory.h"
+
+namespace {
+
+constexpr std::size_t kHeapSize = 1 << 22;
+constexpr std::size_t kMaxLive = 256;
+constexpr std::size_t kMaxBlock = 1024;
+constexpr std::size_t kRuns = 5;
+
+// Replays the same seeded mix of malloc, realloc and free on a fresh heap and
+// returns the average time per operation.
+double Run(std::size_t operations) {
+  Memory::init(kHeapSize);
+  std::mt19937 random(42);
+  std::vector<void *> live;
+  live.reserve(kMaxLive);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < operations; ++i) {
+    const std::size_t size = 16 + random() % kMaxBlock;
+    const std::size_t choice = random() % 10;
+    if (live.size() < kMaxLive && (live.empty() || choice < 5)) {
+      if (void *ptr = Memory::malloc(size)) live.push_back(ptr);
+    } else if (choice < 7) {
+      void *&ptr = live[random() % live.size()];
+      if (void *moved = Memory::realloc(ptr, size)) ptr = moved;
+    } else {
+      const std::size_t index = random() % live.size();
+      Memory::free(live[index]);
+      live[index] = live.back();
+      live.pop_back();
+    }
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  for (void *ptr : live) {
+    Memory::free(ptr);
+  }
+  return elapsed.count() / operations;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t operations = 200000;
+  if (argc > 1) {
+    try {
+      operations = std::stoull(argv[1]);
+    } catch (const std::exception &) {
+      operations = 0;
+    }
+  }
+  if (argc > 2 || !operations) {
+    std::cerr << "Usage: " << argv[0] << " [operations]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<double> results;
+  for (std::size_t run = 0; run < kRuns; ++run) {
+    results.push_back(Run(operations));
+  }
+  std::sort(results.begin(), results.end());
+
+#ifdef MEMORY_CHECKED
+  const char *build = "checked";
+#else
+  const char *build = "default";
+#endif
+  std::cout << "MemoryBenchmark (" << build << " build): " << operations
+            << " operations, median of " << kRuns << " runs: "
+            << results[kRuns / 2] << " ns/op\n";
+  return EXIT_SUCCESS;
+}
@@ -24,7 +24,7 @@ std::size_t AbstractInterface::ShowMenu(const std::string &menu,
   std::getline(std::cin, line);
 
   std::int64_t result;
-  while (!sscanf(line.c_str(), "%lld", &result) || result <= min ||
+  while (!sscanf(line.c_str(), "%" SCNd64, &result) || result <= min ||
          result >= max) {
     std::cout << "Incorrect input, try again: ";
     std::getline(std::cin, line);
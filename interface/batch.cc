@@ -0,0 +1,298 @@
+#include "batch.h"
+
+const std::regex Batch::m_write{
+    R"(^\s*(\w+)\s+(\w+)(?:\[([1-9]\d*)\])?\s*\{([^}]*)\}\s*;?\s*$)"};
+
+Batch::Batch(const std::filesystem::path &path) : m_script(path) {
+  InitCommands();
+}
+
+void Batch::InitCommands() {
+  m_commands["init"] = [this](std::istringstream &args) -> std::string {
+    const std::size_t size = Number(args);
+    std::string mode;
+    args >> mode;
+    if (!mode.empty() && mode != "numa") {
+      throw std::invalid_argument("expected: init <size> [numa]");
+    }
+    const bool initialized =
+        Measure([size, &mode]() { return Memory::init(size, mode == "numa"); });
+    m_handles.clear();
+    if (!initialized) {
+      throw std::runtime_error("cannot initialize the heap");
+    }
+    return "ok";
+  };
+
+  m_commands["malloc"] = [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    const std::size_t size = Number(args);
+    return Allocated(name, Measure([size]() { return Memory::malloc(size); }));
+  };
+
+  m_commands["malloc_onlyfree"] =
+      [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    const std::size_t size = Number(args);
+    return Allocated(
+        name, Measure([size]() { return Memory::malloc_onlyfree(size); }));
+  };
+
+  m_commands["calloc"] = [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    const std::size_t num = Number(args);
+    const std::size_t size = Number(args);
+    return Allocated(
+        name, Measure([num, size]() { return Memory::calloc(num, size); }));
+  };
+
+  m_commands["calloc_onlyfree"] =
+      [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    const std::size_t num = Number(args);
+    const std::size_t size = Number(args);
+    return Allocated(name, Measure([num, size]() {
+                       return Memory::calloc_onlyfree(num, size);
+                     }));
+  };
+
+  m_commands["realloc"] = [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    void *ptr = Handle(name);
+    const std::size_t size = Number(args);
+    return Allocated(
+        name, Measure([ptr, size]() { return Memory::realloc(ptr, size); }));
+  };
+
+  m_commands["realloc_onlyfree"] =
+      [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    void *ptr = Handle(name);
+    const std::size_t size = Number(args);
+    return Allocated(name, Measure([ptr, size]() {
+                       return Memory::realloc_onlyfree(ptr, size);
+                     }));
+  };
+
+  m_commands["free"] = [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    void *ptr = Handle(name);
+    Measure([ptr]() {
+      Memory::free(ptr);
+      return true;
+    });
+    m_handles.erase(name);
+    return "ok";
+  };
+
+  m_commands["free_onlyfree"] =
+      [this](std::istringstream &args) -> std::string {
+    const std::string name = Word(args);
+    void *ptr = Handle(name);
+    Measure([ptr]() {
+      Memory::free_onlyfree(ptr);
+      return true;
+    });
+    m_handles.erase(name);
+    return "ok";
+  };
+
+  m_commands["write"] = [this](std::istringstream &args) -> std::string {
+    std::string input;
+    std::getline(args, input);
+    std::smatch match;
+    if (!std::regex_match(input, match, m_write)) {
+      throw std::invalid_argument("expected: write <name> <type>[n] {a, b}");
+    }
+    void *ptr = Handle(match[1]);
+    const std::string type = match[2];
+    const std::size_t length =
+        match[3].length() ? std::stoull(match[3]) : std::size_t{1};
+
+    std::vector<std::string> tokens;
+    std::string token;
+    std::istringstream iss(match[4]);
+    while (tokens.size() < length && std::getline(iss, token, ',')) {
+      token.erase(std::remove_if(token.begin(), token.end(), ::isspace),
+                  token.end());
+      if (!token.empty()) tokens.push_back(token);
+    }
+
+    bool written = false;
+    if (type == "char") {
+      std::vector<char> values;
+      for (const auto &item : tokens) values.push_back(item.front());
+      written = Measure([ptr, &values]() { return Memory::write(ptr, values); });
+    } else if (type == "int") {
+      std::vector<int> values;
+      for (const auto &item : tokens) values.push_back(std::stoi(item));
+      written = Measure([ptr, &values]() { return Memory::write(ptr, values); });
+    } else if (type == "double") {
+      std::vector<double> values;
+      for (const auto &item : tokens) values.push_back(std::stod(item));
+      written = Measure([ptr, &values]() { return Memory::write(ptr, values); });
+    } else {
+      throw std::invalid_argument("unknown type " + type);
+    }
+    if (!written) {
+      throw std::runtime_error("the data does not fit into the block");
+    }
+    return "true";
+  };
+
+  m_commands["defrag"] = [this](std::istringstream &) -> std::string {
+    Measure([]() {
+      Memory::defragmentation();
+      return true;
+    });
+    // Blocks have moved, so every handle now points at stale memory.
+    m_handles.clear();
+    return "ok";
+  };
+
+  m_commands["stats"] = [this](std::istringstream &) -> std::string {
+    const Memory::Stats stats = Measure([]() { return Memory::stats(); });
+    std::ostringstream oss;
+    oss << "heap " << stats.heap_size << ", used " << stats.used_blocks
+        << " blocks / " << stats.used_bytes << " bytes, free "
+        << stats.free_blocks << " blocks / " << stats.free_bytes
+        << " bytes, largest free " << stats.largest_free;
+    if (stats.quarantined_blocks) {
+      oss << ", quarantined " << stats.quarantined_blocks << " blocks / "
+          << stats.quarantined_bytes << " bytes";
+    }
+    return oss.str();
+  };
+
+  m_commands["verify"] = [this](std::istringstream &) -> std::string {
+    if (!Measure([]() { return Memory::verify(); })) {
+      throw std::runtime_error("heap invariants are broken");
+    }
+    return "true";
+  };
+
+  m_commands["dump"] = [this](std::istringstream &) -> std::string {
+    Measure([]() {
+      Memory::dump();
+      return true;
+    });
+    return "ok";
+  };
+
+  m_commands["snapshot"] = [this](std::istringstream &args) -> std::string {
+    const std::string path = Word(args);
+    if (!Measure([&path]() { return Memory::snapshot(path); })) {
+      throw std::runtime_error("cannot write " + path);
+    }
+    return "true";
+  };
+
+  m_commands["sample"] = [this](std::istringstream &args) -> std::string {
+    const std::size_t rate = Number(args);
+    Measure([rate]() {
+      Memory::set_sample_rate(rate);
+      return true;
+    });
+    return "ok";
+  };
+
+  m_commands["profile"] = [this](std::istringstream &args) -> std::string {
+    const std::string path = Word(args);
+    std::ofstream file(path);
+    std::string kind;
+    args >> kind;
+    Measure([&file, &kind]() {
+      Memory::dump_profile(file, kind != "total");
+      return true;
+    });
+    if (!file) {
+      throw std::runtime_error("cannot write " + path);
+    }
+    return "true";
+  };
+
+  m_commands["numa"] = [](std::istringstream &args) -> std::string {
+    Memory::simulate_numa(Number(args));
+    return "ok";
+  };
+
+  m_commands["bind"] = [](std::istringstream &args) -> std::string {
+    Memory::bind_thread(Number(args));
+    return "ok";
+  };
+}
+
+void Batch::Exec() {
+  if (!m_script) {
+    std::cerr << "Cannot open the command file\n";
+    ++m_failures;
+    return;
+  }
+
+  std::string line;
+  std::size_t number = 0, commands = 0;
+  std::chrono::nanoseconds total{0};
+  while (std::getline(m_script, line)) {
+    ++number;
+    line.erase(std::min(line.find('#'), line.size()));
+    std::istringstream args(line);
+    std::string name;
+    if (!(args >> name)) continue;
+
+    ++commands;
+    m_elapsed = std::chrono::nanoseconds::zero();
+    std::string result;
+    try {
+      auto command = m_commands.find(name);
+      if (command == m_commands.end()) {
+        throw std::invalid_argument("unknown command " + name);
+      }
+      result = command->second(args);
+    } catch (const std::exception &error) {
+      ++m_failures;
+      result = std::string("error: ") + error.what();
+    }
+    total += m_elapsed;
+
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    std::cout << number << ": " << line.substr(line.find(name)) << " -> "
+              << result << " [" << m_elapsed.count() << " ns]\n";
+  }
+
+  std::cout << "Total: " << commands << " commands, " << m_failures
+            << " failed, " << total.count() << " ns in the allocator\n";
+}
+
+[[nodiscard]] bool Batch::Succeeded() const noexcept { return !m_failures; }
+
+std::string Batch::Allocated(const std::string &name, void *ptr) {
+  if (!ptr) return "null";
+  m_handles[name] = ptr;
+  std::ostringstream oss;
+  oss << ptr;
+  return oss.str();
+}
+
+void *Batch::Handle(const std::string &name) const {
+  auto handle = m_handles.find(name);
+  if (handle == m_handles.end()) {
+    throw std::invalid_argument("unknown block " + name);
+  }
+  return handle->second;
+}
+
+std::size_t Batch::Number(std::istringstream &args) {
+  std::string token;
+  if (!(args >> token)) {
+    throw std::invalid_argument("missing numeric argument");
+  }
+  return std::stoull(token);
+}
+
+std::string Batch::Word(std::istringstream &args) {
+  std::string token;
+  if (!(args >> token)) {
+    throw std::invalid_argument("missing argument");
+  }
+  return token;
+}
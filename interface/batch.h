@@ -0,0 +1,47 @@
+#pragma once
+
+#include <fstream>
+#include <map>
+
+#include "ainterface.h"
+#include "memory.h"
+
+class Batch final : virtual public AbstractInterface {
+ public:
+  explicit Batch(const std::filesystem::path &path);
+  explicit Batch(const Batch &other) = delete;
+  explicit Batch(Batch &&other) = delete;
+  Batch &operator=(const Batch &other) = delete;
+  Batch &operator=(Batch &&other) = delete;
+  ~Batch() = default;
+
+  virtual void Exec() final override;
+
+  [[nodiscard]] bool Succeeded() const noexcept;
+
+ private:
+  using Command = std::function<std::string(std::istringstream &args)>;
+
+  static const std::regex m_write;
+
+  void InitCommands();
+
+  template <typename F>
+  auto Measure(F &&func) {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = func();
+    m_elapsed = std::chrono::steady_clock::now() - start;
+    return result;
+  }
+
+  std::string Allocated(const std::string &name, void *ptr);
+  void *Handle(const std::string &name) const;
+  static std::size_t Number(std::istringstream &args);
+  static std::string Word(std::istringstream &args);
+
+  std::ifstream m_script;
+  std::map<std::string, Command> m_commands;
+  std::map<std::string, void *> m_handles;
+  std::chrono::nanoseconds m_elapsed{0};
+  std::size_t m_failures{0};
+};
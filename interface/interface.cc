@@ -21,6 +21,7 @@ const std::vector<std::string> Interface::AbstractInterface::m_menus{
     "| 11. void free_onlyfree (void* ptr)                           |\n"
     "| 12. Research on optimizing the search for free blocks        |\n"
     "| 13. defragmentation                                          |\n"
+    "| 14. bool snapshot(const std::filesystem::path& path)         |\n"
     " -------------------------------------------------------------- \n"
     " > ",
     " -------------------------------------------------------------- \n"
@@ -57,7 +58,8 @@ const std::vector<std::regex> Interface::m_patterns{
         R"(0x([0-9A-Fa-f]+) (\w+)(?:\[([1-9]\d*)\])?\s+\{((?:\s*[^\s,]+(?:\s*,\s*[^\s,]+)*)?)\s*\};)"),
     std::regex("^0x([0-9A-Fa-f]+)\\s+([1-9][0-9]*)$"),
     std::regex("^([1-9][0-9]*)\\s+([1-9][0-9]*)$"),
-    std::regex("^0x([0-9A-Fa-f]+)$"), std::regex("^([1-9][0-9]*)$")};
+    std::regex("^0x([0-9A-Fa-f]+)$"), std::regex("^([1-9][0-9]*)$"),
+    std::regex("^(\\S+)$")};
 
 Interface::Interface() {
   InitFuncMenus();
@@ -109,7 +111,10 @@ void Interface::InitFuncMenus() {
       []() -> bool {
         Memory::defragmentation();
         return true;
-      }};
+      },
+      std::bind(&Interface::RunMenu, this,
+                std::ref(m_funcs[MenuFuncs::kSnapshotFuncMenu]),
+                MenuItem::kArgumentsMenu)};
 
   m_funcs[MenuFuncs::kMemAllocFuncMenu] = {
       std::bind(&Interface::Exit, this),
@@ -244,6 +249,13 @@ void Interface::InitFuncMenus() {
                   Memory::free_onlyfree(ptr);
                 })};
 
+  m_funcs[MenuFuncs::kSnapshotFuncMenu] = {
+      std::bind(&Interface::Exit, this),
+      std::bind(&Interface::RunMemoryMenu, this, m_patterns[5],
+                [](const std::smatch &match) -> void {
+                  std::cout << Memory::snapshot(match[1].str()) << '\n';
+                })};
+
   m_funcs[MenuFuncs::kStatisticFuncMenu] = {
       std::bind(&Interface::Exit, this), []() -> bool {
         const std::size_t ELEMENTS = 1e5;
@@ -28,6 +28,7 @@ class Interface final : virtual public AbstractInterface {
     kReallocOnlyFreeFuncMenu,
     kFreeOnlyFreeFuncMenu,
     kStatisticFuncMenu,
+    kSnapshotFuncMenu,
     kMenuFuncsAll
   };
 
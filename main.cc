@@ -1,7 +1,13 @@
+#include "batch.h"
 #include "interface.h"
 
-int main() {
+int main(int argc, char *argv[]) {
   setlocale(LC_ALL, "C.UTF-8");
+  if (argc > 1) {
+    Batch batch(argv[1]);
+    batch.Exec();
+    return batch.Succeeded() ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
   Interface interface;
   interface.Exec();
   return EXIT_SUCCESS;
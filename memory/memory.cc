@@ -1,8 +1,22 @@
 #include "memory.h"
 
+#include "numa.h"
+#include "profiler.h"
+#include "snapshot.h"
+
 namespace Memory {
 
+#ifdef MEMORY_CHECKED
+constexpr const std::uint64_t USED_MAGIC = 0x55534544424C4F43ULL;
+constexpr const std::uint64_t FREE_MAGIC = 0x46524545424C4F43ULL;
+constexpr const std::uint64_t QUARANTINE_MAGIC = 0x51554152424C4F43ULL;
+#endif
+
 struct Header {
+#ifdef MEMORY_CHECKED
+  std::uint64_t magic{FREE_MAGIC};
+  std::size_t requested{0};
+#endif
   std::byte* addr;
   std::size_t size;
   bool used;
@@ -16,27 +30,57 @@ struct Header {
 
 constexpr const std::size_t HEADER_SIZE = sizeof(Header);
 
-static std::byte* heap = nullptr;
-static std::size_t heap_size = 0;
-static Header* heap_head = nullptr;
-static std::vector<Header*> vacant;
+#ifdef MEMORY_CHECKED
+constexpr const std::size_t QUARANTINE_BLOCKS = 64;
+constexpr const std::size_t QUARANTINE_BYTES = 1U << 20;
+#endif
+
+struct Arena {
+  std::byte* heap{nullptr};
+  std::size_t heap_size{0};
+  Header* heap_head{nullptr};
+  std::vector<Header*> vacant;
+  std::size_t node{0};
+  std::mutex lock;
+#ifdef MEMORY_CHECKED
+  std::array<Header*, QUARANTINE_BLOCKS> quarantine{};
+  std::size_t quarantine_first{0};
+  std::size_t quarantine_count{0};
+  std::size_t quarantine_bytes{0};
+#endif
+};
+
+static std::vector<std::unique_ptr<Arena>> arenas;
 
 void cleanup() {
-  if (heap) {
-    std::free(heap);
+  for (auto& arena : arenas) {
+    Numa::unmap(arena->heap, arena->heap_size);
   }
-  heap = nullptr;
-  heap_head = nullptr;
+  arenas.clear();
 }
 
-static void remove_free_block(const Header* block) noexcept {
-  auto item = std::find(vacant.begin(), vacant.end(), block);
-  if (item != vacant.end()) {
-    vacant.erase(item);
+static Arena* owner(const void* ptr) noexcept {
+  auto* const start = static_cast<const std::byte*>(ptr);
+  for (auto& arena : arenas) {
+    if (arena->heap <= start && start < arena->heap + arena->heap_size) {
+      return arena.get();
+    }
   }
+  return nullptr;
+}
+
+static std::size_t home() noexcept {
+  return Numa::current_node() % arenas.size();
 }
 
-static void split_block(Header& block, std::size_t size) noexcept {
+static void remove_free_block(Arena& arena, const Header* block) noexcept {
+  auto item = std::find(arena.vacant.begin(), arena.vacant.end(), block);
+  if (item != arena.vacant.end()) {
+    arena.vacant.erase(item);
+  }
+}
+
+static void split_block(Arena& arena, Header& block, std::size_t size) noexcept {
   auto* const pivot = block.addr + size;
   auto const dimension = block.size - size - HEADER_SIZE;
 
@@ -49,44 +93,227 @@ static void split_block(Header& block, std::size_t size) noexcept {
 
   block.size = size;
 
-  vacant.push_back(header);
+  arena.vacant.push_back(header);
 }
 
-static void merge_block(Header& first, Header& second) noexcept {
+static void merge_block(Arena& arena, Header& first, Header& second) noexcept {
   first.next = second.next;
   if (second.next) second.next->prev = &first;
   first.size += second.size + HEADER_SIZE;
-  remove_free_block(&second);
+  remove_free_block(arena, &second);
+}
+
+static void release(Arena& arena, Header* block) noexcept {
+  block->used = false;
+
+  bool merged = false;
+  if (block->prev && !block->prev->used) {
+    merge_block(arena, *block->prev, *block);
+    block = block->prev;
+    merged = true;
+  }
+
+  if (block->next && !block->next->used) {
+    merge_block(arena, *block, *block->next);
+  }
+
+  if (!merged) {
+    arena.vacant.push_back(block);
+  }
+}
+
+#ifdef MEMORY_CHECKED
+constexpr const std::size_t CANARY_SIZE = sizeof(std::uint64_t);
+constexpr const std::uint64_t CANARY = 0xCA7AC0DECA7AC0DEULL;
+constexpr const unsigned char POISON = 0xDD;
+
+[[noreturn]] static void report(const char* error, const char* where,
+                                const void* ptr, const Arena* arena,
+                                const Header* block) noexcept {
+  std::cerr << "Memory: " << error << " in " << where << "(" << ptr << ")";
+  if (block) {
+    std::cerr << ", block header " << block << " at heap offset "
+              << reinterpret_cast<const std::byte*>(block) - arena->heap
+              << " of node " << arena->node << ", size " << block->size
+              << ", requested " << block->requested;
+  }
+  std::cerr << std::endl;
+  std::abort();
+}
+
+static Header* validate(const Arena* arena, void* ptr,
+                        const char* where) noexcept {
+  auto* const start = static_cast<std::byte*>(ptr);
+  if (!arena || start < arena->heap + HEADER_SIZE) {
+    report("pointer outside of the heap", where, ptr, arena, nullptr);
+  }
+
+  auto* const block = reinterpret_cast<Header*>(start - HEADER_SIZE);
+  if (block->magic == QUARANTINE_MAGIC || block->magic == FREE_MAGIC) {
+    report("double free or use of a freed block", where, ptr, arena, block);
+  }
+  if (block->magic != USED_MAGIC || block->addr != start || !block->used ||
+      (block->prev ? block->prev->next != block : block != arena->heap_head)) {
+    report("invalid pointer or corrupted block header", where, ptr, arena,
+           block);
+  }
+  if (block->requested + CANARY_SIZE > block->size ||
+      std::memcmp(start + block->requested, &CANARY, CANARY_SIZE)) {
+    report("write past the end of the block", where, ptr, arena, block);
+  }
+  return block;
+}
+
+static void arm(Header& block, std::size_t size) noexcept {
+  block.magic = USED_MAGIC;
+  block.requested = size;
+  std::memcpy(block.addr + size, &CANARY, CANARY_SIZE);
+}
+
+static std::size_t usable(const Header& block) noexcept {
+  return block.magic == USED_MAGIC ? block.requested : 0;
 }
 
-void init(std::size_t size) {
-  if (size < HEADER_SIZE) {
+static bool quarantined(const Header& block) noexcept {
+  return block.magic == QUARANTINE_MAGIC;
+}
+
+static void evict(Arena& arena, const char* where) noexcept {
+  Header* const block = arena.quarantine[arena.quarantine_first];
+  arena.quarantine_first = (arena.quarantine_first + 1) % QUARANTINE_BLOCKS;
+  --arena.quarantine_count;
+  arena.quarantine_bytes -= block->size;
+
+  auto* const end = block->addr + block->size;
+  auto* const dirty = std::find_if(block->addr, end, [](std::byte value) {
+    return std::to_integer<unsigned char>(value) != POISON;
+  });
+  if (dirty != end) {
+    report("write to a freed block", where, dirty, &arena, block);
+  }
+
+  block->magic = FREE_MAGIC;
+  release(arena, block);
+}
+
+static void retire(Arena& arena, Header* block, const char* where) noexcept {
+  std::memset(block->addr, POISON, block->size);
+  block->magic = QUARANTINE_MAGIC;
+
+  while (arena.quarantine_count == QUARANTINE_BLOCKS ||
+         (arena.quarantine_count &&
+          arena.quarantine_bytes + block->size > QUARANTINE_BYTES)) {
+    evict(arena, where);
+  }
+  arena.quarantine[(arena.quarantine_first + arena.quarantine_count) %
+                   QUARANTINE_BLOCKS] = block;
+  ++arena.quarantine_count;
+  arena.quarantine_bytes += block->size;
+}
+
+static void flush_quarantine(Arena& arena, const char* where) noexcept {
+  while (arena.quarantine_count) {
+    evict(arena, where);
+  }
+}
+#else
+constexpr const std::size_t CANARY_SIZE = 0;
+
+static Header* validate(const Arena*, void* ptr, const char*) noexcept {
+  return reinterpret_cast<Header*>(static_cast<std::byte*>(ptr) - HEADER_SIZE);
+}
+
+static void arm(Header&, std::size_t) noexcept {}
+
+static std::size_t usable(const Header& block) noexcept { return block.size; }
+
+static bool quarantined(const Header&) noexcept { return false; }
+
+static void retire(Arena& arena, Header* block, const char*) noexcept {
+  release(arena, block);
+}
+
+static void flush_quarantine(Arena&, const char*) noexcept {}
+#endif
+
+// Larger requests would wrap around once the canary is added.
+constexpr const std::size_t MAX_REQUEST = SIZE_MAX - CANARY_SIZE;
+
+bool init(std::size_t size, bool per_node) {
+  const std::size_t nodes = per_node ? Numa::nodes() : 1;
+  if (size / nodes < HEADER_SIZE) {
     std::cout << "You must specify the size of the allocated memory greater "
                  "than the size of the header equal to "
-              << HEADER_SIZE << "\n";
-    return;
+              << HEADER_SIZE << " for each of the " << nodes
+              << " NUMA nodes\n";
+    return false;
   }
-  if (heap) {
-    std::free(heap);
+  cleanup();
+  if (Profiler::enabled()) {
+    Profiler::on_reset();
   }
-  heap = static_cast<std::byte*>(std::malloc(size));
-  heap_size = size;
 
-  heap_head =
-      new (heap) Header(heap + HEADER_SIZE, heap_size - HEADER_SIZE, false);
-  vacant.push_back(heap_head);
+  for (std::size_t node = 0; node < nodes; ++node) {
+    auto arena = std::make_unique<Arena>();
+    arena->node = node;
+    arena->heap_size = size / nodes + (node + 1 == nodes ? size % nodes : 0);
+    arena->heap =
+        Numa::map(arena->heap_size, per_node ? node : Numa::ANY_NODE);
+    if (!arena->heap) {
+      std::cout << "Cannot reserve " << arena->heap_size
+                << " bytes of memory for NUMA node " << node << "\n";
+      cleanup();
+      return false;
+    }
+
+    arena->heap_head = new (arena->heap)
+        Header(arena->heap + HEADER_SIZE, arena->heap_size - HEADER_SIZE, false);
+    arena->vacant.push_back(arena->heap_head);
+    arenas.push_back(std::move(arena));
+  }
   std::atexit(cleanup);
+  return true;
+}
+
+static void deallocate(void* ptr, const char* where) noexcept {
+  if (!ptr) return;
+
+  Arena* const arena = owner(ptr);
+#ifndef MEMORY_CHECKED
+  if (!arena) return;
+#endif
+  std::unique_lock<std::mutex> guard;
+  if (arena) guard = std::unique_lock<std::mutex>(arena->lock);
+
+  auto* const block = validate(arena, ptr, where);
+  if (Profiler::enabled()) {
+    Profiler::on_free(ptr);
+  }
+  retire(*arena, block, where);
 }
 
 void* malloc(std::size_t size) {
-  for (auto* curr = heap_head; curr; curr = curr->next) {
-    if (!curr->used && curr->size >= size) {
-      if ((curr->size - size) >= HEADER_SIZE) {
-        split_block(*curr, size);
+  if (arenas.empty() || size > MAX_REQUEST) return nullptr;
+
+  const std::size_t capacity = size + CANARY_SIZE;
+  const std::size_t local = home();
+  for (std::size_t i = 0; i < arenas.size(); ++i) {
+    Arena& arena = *arenas[(local + i) % arenas.size()];
+    std::lock_guard<std::mutex> guard(arena.lock);
+    for (auto* curr = arena.heap_head; curr; curr = curr->next) {
+      if (!curr->used && curr->size >= capacity) {
+        if ((curr->size - capacity) >= HEADER_SIZE) {
+          split_block(arena, *curr, capacity);
+        }
+        remove_free_block(arena, curr);
+        curr->used = true;
+        curr->type = std::type_index(typeid(char));
+        arm(*curr, size);
+        if (Profiler::enabled()) {
+          Profiler::on_alloc(curr->addr, size);
+        }
+        return static_cast<void*>(curr->addr);
       }
-      remove_free_block(curr);
-      curr->used = true;
-      return static_cast<void*>(curr->addr);
     }
   }
 
@@ -103,63 +330,83 @@ void* calloc(std::size_t num, std::size_t size) {
 
 void* realloc(void* ptr, std::size_t size) {
   if (!ptr) return malloc(size);
-
-  auto* const block = reinterpret_cast<Header*>(static_cast<std::byte*>(ptr) - HEADER_SIZE);
-  if (block->size >= size) {
-    if ((block->size - size) >= HEADER_SIZE) {
-      split_block(*block, size);
+  if (size > MAX_REQUEST) return nullptr;
+
+  Arena* const arena = owner(ptr);
+#ifndef MEMORY_CHECKED
+  if (!arena) return nullptr;
+#endif
+  std::size_t previous = 0;
+  {
+    std::unique_lock<std::mutex> guard;
+    if (arena) guard = std::unique_lock<std::mutex>(arena->lock);
+
+    auto* const block = validate(arena, ptr, "realloc");
+    const std::size_t capacity = size + CANARY_SIZE;
+    if (block->size >= capacity) {
+      if ((block->size - capacity) >= HEADER_SIZE) {
+        split_block(*arena, *block, capacity);
+      }
+      arm(*block, size);
+      if (Profiler::enabled()) {
+        Profiler::on_resize(ptr, size);
+      }
+      return ptr;
     }
-    return ptr;
-  }
 
-  if (block->next && !block->next->used && block->size + block->next->size + HEADER_SIZE >= size) {
-    merge_block(*block, *block->next);
-    if ((block->size - size) >= HEADER_SIZE) {
-      split_block(*block, size);
+    if (block->next && !block->next->used && block->size + block->next->size + HEADER_SIZE >= capacity) {
+      merge_block(*arena, *block, *block->next);
+      block->type = std::type_index(typeid(char));
+      if ((block->size - capacity) >= HEADER_SIZE) {
+        split_block(*arena, *block, capacity);
+      }
+      arm(*block, size);
+      if (Profiler::enabled()) {
+        Profiler::on_resize(ptr, size);
+      }
+      return ptr;
     }
-    return ptr;
+    previous = usable(*block);
   }
 
   auto* const modern = malloc(size);
   if (modern) {
-    std::memcpy(modern, ptr, block->size);
-    free(ptr);
+    std::memcpy(modern, ptr, std::min(previous, size));
+    deallocate(ptr, "realloc");
     return modern;
   }
 
   return nullptr;
 }
 
-void free(void* ptr) noexcept {
-  if (!ptr) return;
-
-  auto* block = reinterpret_cast<Header*>(static_cast<std::byte*>(ptr) - HEADER_SIZE);
-  block->used = false;
 
-  if (block->prev && !block->prev->used) {
-    merge_block(*block->prev, *block);
-    block = block->prev;
-  }
-
-  if (block->next && !block->next->used) {
-    merge_block(*block, *block->next);
-  }
-
-  vacant.push_back(block);
-}
+void free(void* ptr) noexcept { deallocate(ptr, "free"); }
 
 void* malloc_onlyfree(std::size_t size) {
-  auto item = std::find_if(
-      vacant.begin(), vacant.end(),
-      [size](const Header* header) { return header->size >= size; });
-  if (item != vacant.end()) {
-    Header* const block = *item;
-    vacant.erase(item);
-    if ((block->size - size) >= HEADER_SIZE) {
-      split_block(*block, size);
+  if (arenas.empty() || size > MAX_REQUEST) return nullptr;
+
+  const std::size_t capacity = size + CANARY_SIZE;
+  const std::size_t local = home();
+  for (std::size_t i = 0; i < arenas.size(); ++i) {
+    Arena& arena = *arenas[(local + i) % arenas.size()];
+    std::lock_guard<std::mutex> guard(arena.lock);
+    auto item = std::find_if(
+        arena.vacant.begin(), arena.vacant.end(),
+        [capacity](const Header* header) { return header->size >= capacity; });
+    if (item != arena.vacant.end()) {
+      Header* const block = *item;
+      arena.vacant.erase(item);
+      if ((block->size - capacity) >= HEADER_SIZE) {
+        split_block(arena, *block, capacity);
+      }
+      block->used = true;
+      block->type = std::type_index(typeid(char));
+      arm(*block, size);
+      if (Profiler::enabled()) {
+        Profiler::on_alloc(block->addr, size);
+      }
+      return static_cast<void*>(block->addr);
     }
-    block->used = true;
-    return static_cast<void*>(block->addr);
   }
   return nullptr;
 }
@@ -174,67 +421,104 @@ void* calloc_onlyfree(std::size_t num, std::size_t size) {
 
 void* realloc_onlyfree(void* ptr, std::size_t size) {
   if (!ptr) return malloc_onlyfree(size);
-
-  auto* const block = reinterpret_cast<Header*>(static_cast<std::byte*>(ptr) - HEADER_SIZE);
-  if (block->size >= size) {
-    if ((block->size - size) >= HEADER_SIZE) {
-      split_block(*block, size);
+  if (size > MAX_REQUEST) return nullptr;
+
+  Arena* const arena = owner(ptr);
+#ifndef MEMORY_CHECKED
+  if (!arena) return nullptr;
+#endif
+  std::size_t previous = 0;
+  {
+    std::unique_lock<std::mutex> guard;
+    if (arena) guard = std::unique_lock<std::mutex>(arena->lock);
+
+    auto* const block = validate(arena, ptr, "realloc_onlyfree");
+    const std::size_t capacity = size + CANARY_SIZE;
+    if (block->size >= capacity) {
+      if ((block->size - capacity) >= HEADER_SIZE) {
+        split_block(*arena, *block, capacity);
+      }
+      arm(*block, size);
+      if (Profiler::enabled()) {
+        Profiler::on_resize(ptr, size);
+      }
+      return ptr;
     }
-    return ptr;
-  }
 
-  if (block->next && !block->next->used && block->size + block->next->size + HEADER_SIZE >= size) {
-    merge_block(*block, *block->next);
-    if ((block->size - size) >= HEADER_SIZE) {
-      split_block(*block, size);
+    if (block->next && !block->next->used && block->size + block->next->size + HEADER_SIZE >= capacity) {
+      merge_block(*arena, *block, *block->next);
+      block->type = std::type_index(typeid(char));
+      if ((block->size - capacity) >= HEADER_SIZE) {
+        split_block(*arena, *block, capacity);
+      }
+      arm(*block, size);
+      if (Profiler::enabled()) {
+        Profiler::on_resize(ptr, size);
+      }
+      return ptr;
     }
-    return ptr;
+    previous = usable(*block);
   }
 
   auto* const modern = malloc_onlyfree(size);
   if (modern) {
-    std::memcpy(modern, ptr, block->size);
-    free(ptr);
+    std::memcpy(modern, ptr, std::min(previous, size));
+    deallocate(ptr, "realloc_onlyfree");
     return modern;
   }
 
   return nullptr;
 }
 
-void free_onlyfree(void* ptr) { free(ptr); }
+void free_onlyfree(void* ptr) { deallocate(ptr, "free_onlyfree"); }
 
-void defragmentation() {
-  vacant.clear();
+static void defragmentation(Arena& arena) {
+  flush_quarantine(arena, "defragmentation");
+  arena.vacant.clear();
+
+  // Slide every used block down to the end of the previous one, then turn
+  // whatever is left at the top of the heap into a single free block.
+  std::byte* insert = arena.heap;
   Header* last = nullptr;
-  for (Header* block = heap_head; block; block = block->next) {
-    Header* potential = block->next;
-    for (; potential && !potential->used; potential = potential->next)
-      ;
-    if (potential) {
-      std::byte* insert = block->addr + block->size;
-      if (!block->used) {
-        insert = reinterpret_cast<std::byte*>(block);
-        potential->prev = nullptr;
-      }
-      potential->addr = insert + HEADER_SIZE;
-      block->next = reinterpret_cast<Header*>(insert);
-      if (potential->prev) {
-        potential->prev = block;
-      }
-      if (potential->next) {
-        potential->next->prev = reinterpret_cast<Header*>(insert);
+  for (Header* block = arena.heap_head; block;) {
+    Header* const next = block->next;
+    if (block->used) {
+      auto* const moved = reinterpret_cast<Header*>(insert);
+      if (moved != block) {
+        if (Profiler::enabled()) {
+          Profiler::on_move(block->addr, insert + HEADER_SIZE);
+        }
+        std::memmove(insert, reinterpret_cast<std::byte*>(block),
+                     block->size + HEADER_SIZE);
+        moved->addr = insert + HEADER_SIZE;
       }
-      std::memmove(insert, reinterpret_cast<std::byte*>(potential),
-                   potential->size + HEADER_SIZE);
-      last = reinterpret_cast<Header*>(insert);
+      moved->prev = last;
+      if (last) last->next = moved;
+      last = moved;
+      insert += moved->size + HEADER_SIZE;
     }
+    block = next;
   }
-  if (last) {
-    last->next = nullptr;
-    std::size_t save_size = last->size;
-    last->size =
-        heap + heap_size - (reinterpret_cast<std::byte*>(last) + HEADER_SIZE);
-    split_block(*last, save_size);
+
+  const std::size_t rest = arena.heap + arena.heap_size - insert;
+  if (rest >= HEADER_SIZE) {
+    auto* const tail =
+        new (insert) Header(insert + HEADER_SIZE, rest - HEADER_SIZE, false);
+    tail->prev = last;
+    if (last) last->next = tail;
+    arena.vacant.push_back(tail);
+    last = tail;
+  } else {
+    last->size += rest;
+  }
+  last->next = nullptr;
+  arena.heap_head = reinterpret_cast<Header*>(arena.heap);
+}
+
+void defragmentation() {
+  for (auto& arena : arenas) {
+    std::lock_guard<std::mutex> guard(arena->lock);
+    defragmentation(*arena);
   }
 }
 
@@ -242,9 +526,13 @@ template <typename T>
 bool write(void* ptr, const std::vector<T>& src) {
   std::byte* start = reinterpret_cast<std::byte*>(ptr);
   auto size = sizeof(T) * src.size();
-  for (Header* block = heap_head; block; block = block->next) {
+  Arena* const arena = owner(ptr);
+  if (!arena) return false;
+
+  std::lock_guard<std::mutex> guard(arena->lock);
+  for (Header* block = arena->heap_head; block; block = block->next) {
     if ((block->addr <= start) && (start < (block->addr + block->size))) {
-      if (block->used && block->size >= size) {
+      if (block->used && start + size <= block->addr + usable(*block)) {
         block->type = std::type_index(typeid(T));
         if constexpr (std::is_trivially_copyable_v<T>) {
           std::memcpy(start, src.data(), size);
@@ -264,28 +552,171 @@ template bool write<int>(void*, const std::vector<int>&);
 template bool write<double>(void*, const std::vector<double>&);
 
 void dump() {
-  for (auto* block = heap_head; block; block = block->next) {
-    std::cout << block->addr << '\n';
-
-    std::cout << "\tContent: [";
-    if (block->type == std::type_index(typeid(int))) {
-      auto* data = reinterpret_cast<int*>(block->addr);
-      std::size_t size = block->size / sizeof(int);
-      std::copy_n(data, size, std::ostream_iterator<int>(std::cout, ", "));
-    } else if (block->type == std::type_index(typeid(double))) {
-      auto* data = reinterpret_cast<double*>(block->addr);
-      std::size_t size = block->size / sizeof(double);
-      std::copy_n(data, size, std::ostream_iterator<double>(std::cout, ", "));
-    } else {
-      auto* data = reinterpret_cast<char*>(block->addr);
-      std::size_t size = block->size / sizeof(char);
-      std::copy_n(data, size, std::ostream_iterator<char>(std::cout, ", "));
+  for (auto& arena : arenas) {
+    std::lock_guard<std::mutex> guard(arena->lock);
+    if (arenas.size() > 1) {
+      std::cout << "NUMA node " << arena->node << ":\n";
     }
-    std::cout << "]\n";
+    for (auto* block = arena->heap_head; block; block = block->next) {
+      std::cout << block->addr << '\n';
+
+      std::cout << "\tContent: [";
+      if (block->type == std::type_index(typeid(int))) {
+        auto* data = reinterpret_cast<int*>(block->addr);
+        std::size_t size = block->size / sizeof(int);
+        std::copy_n(data, size, std::ostream_iterator<int>(std::cout, ", "));
+      } else if (block->type == std::type_index(typeid(double))) {
+        auto* data = reinterpret_cast<double*>(block->addr);
+        std::size_t size = block->size / sizeof(double);
+        std::copy_n(data, size,
+                    std::ostream_iterator<double>(std::cout, ", "));
+      } else {
+        auto* data = reinterpret_cast<char*>(block->addr);
+        std::size_t size = block->size / sizeof(char);
+        std::copy_n(data, size, std::ostream_iterator<char>(std::cout, ", "));
+      }
+      std::cout << "]\n";
 
-    std::cout << "\tSize: " << block->size << '\n';
-    std::cout << "\tState: " << block->used << '\n';
+      std::cout << "\tSize: " << block->size << '\n';
+      std::cout << "\tState: " << block->used << '\n';
+    }
   }
 }
 
-}  // namespace Memory
\ No newline at end of file
+static Snapshot::Type type_tag(const std::type_index& type) noexcept {
+  if (type == std::type_index(typeid(char))) return Snapshot::kChar;
+  if (type == std::type_index(typeid(int))) return Snapshot::kInt;
+  if (type == std::type_index(typeid(double))) return Snapshot::kDouble;
+  return Snapshot::kOther;
+}
+
+bool snapshot(const std::filesystem::path& path) {
+  std::vector<std::unique_lock<std::mutex>> guards;
+  std::size_t blocks = 0;
+  std::size_t total = 0;
+  for (auto& arena : arenas) {
+    guards.emplace_back(arena->lock);
+    for (auto* block = arena->heap_head; block; block = block->next) {
+      ++blocks;
+    }
+    total += arena->heap_size;
+  }
+
+  std::vector<std::byte> buffer(sizeof(Snapshot::FileHeader) +
+                                blocks * sizeof(Snapshot::Record));
+  Snapshot::FileHeader header{};
+  std::memcpy(header.magic, Snapshot::MAGIC, sizeof(header.magic));
+  header.heap_size = total;
+  header.header_size = HEADER_SIZE;
+  header.blocks = blocks;
+  std::memcpy(buffer.data(), &header, sizeof(header));
+
+  // Arenas are stored back to back, as if they were one heap.
+  auto* cursor = buffer.data() + sizeof(header);
+  std::size_t base = 0;
+  for (auto& arena : arenas) {
+    for (auto* block = arena->heap_head; block; block = block->next) {
+      Snapshot::Record record{};
+      record.offset =
+          base + (reinterpret_cast<std::byte*>(block) - arena->heap);
+      record.size = block->size;
+      record.used = quarantined(*block) ? Snapshot::kQuarantined
+                    : block->used          ? Snapshot::kUsed
+                                           : Snapshot::kFree;
+      record.type = type_tag(block->type);
+      std::memcpy(cursor, &record, sizeof(record));
+      cursor += sizeof(record);
+    }
+    base += arena->heap_size;
+  }
+  guards.clear();
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  return static_cast<bool>(file);
+}
+
+Stats stats() {
+  Stats result;
+  for (auto& arena : arenas) {
+    std::lock_guard<std::mutex> guard(arena->lock);
+    result.heap_size += arena->heap_size;
+    for (auto* block = arena->heap_head; block; block = block->next) {
+      if (quarantined(*block)) {
+        ++result.quarantined_blocks;
+        result.quarantined_bytes += block->size;
+      } else if (block->used) {
+        ++result.used_blocks;
+        result.used_bytes += block->size;
+      } else {
+        ++result.free_blocks;
+        result.free_bytes += block->size;
+        result.largest_free = std::max(result.largest_free, block->size);
+      }
+    }
+  }
+  return result;
+}
+
+static bool verify(Arena& arena) {
+  auto fail = [&arena](const Header* block, const char* error) {
+    std::cerr << "Memory: " << error << " at block header " << block
+              << " of node " << arena.node << '\n';
+    return false;
+  };
+
+  if (arena.heap_head != reinterpret_cast<Header*>(arena.heap)) {
+    return fail(arena.heap_head, "heap does not start with a block");
+  }
+
+  std::size_t vacant = 0;
+  for (auto* block = arena.heap_head; block; block = block->next) {
+    auto* const end = block->addr + block->size;
+    if (block->addr != reinterpret_cast<std::byte*>(block) + HEADER_SIZE) {
+      return fail(block, "block address does not follow its header");
+    }
+    if (end > arena.heap + arena.heap_size) {
+      return fail(block, "block ends past the heap");
+    }
+    if (block->next ? block->next->prev != block ||
+                          reinterpret_cast<std::byte*>(block->next) != end
+                    : end != arena.heap + arena.heap_size) {
+      return fail(block, "blocks are not contiguous");
+    }
+    if (!block->used) {
+      ++vacant;
+      if (std::count(arena.vacant.begin(), arena.vacant.end(), block) != 1) {
+        return fail(block, "free block is not listed exactly once");
+      }
+    }
+  }
+  if (vacant != arena.vacant.size()) {
+    return fail(nullptr, "free list holds blocks that are not free");
+  }
+  return true;
+}
+
+bool verify() {
+  for (auto& arena : arenas) {
+    std::lock_guard<std::mutex> guard(arena->lock);
+    if (!verify(*arena)) return false;
+  }
+  return true;
+}
+
+void set_sample_rate(std::size_t bytes) { Profiler::configure(bytes); }
+
+void dump_profile(std::ostream& out, bool live) {
+  Profiler::report(out, live);
+}
+
+void simulate_numa(std::size_t nodes) noexcept { Numa::simulate(nodes); }
+
+void bind_thread(std::size_t node) noexcept { Numa::bind_thread(node); }
+
+int numa_node(const void* ptr) noexcept {
+  const Arena* const arena = owner(ptr);
+  return arena ? static_cast<int>(arena->node) : -1;
+}
+
+}  // namespace Memory
@@ -1,16 +1,34 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <typeindex>
 #include <vector>
 
 namespace Memory {
 
-void init(std::size_t size);
+struct Stats {
+  std::size_t heap_size{0};
+  std::size_t used_blocks{0};
+  std::size_t free_blocks{0};
+  std::size_t used_bytes{0};
+  std::size_t free_bytes{0};
+  std::size_t largest_free{0};
+  std::size_t quarantined_blocks{0};
+  std::size_t quarantined_bytes{0};
+};
+
+bool init(std::size_t size, bool per_node = false);
 
 void* malloc(std::size_t size);
 void* calloc(std::size_t num, std::size_t size);
@@ -28,5 +46,16 @@ template <typename T>
 bool write(void* ptr, const std::vector<T>& src);
 
 void dump();
+bool snapshot(const std::filesystem::path& path);
+
+Stats stats();
+bool verify();
+
+void set_sample_rate(std::size_t bytes);
+void dump_profile(std::ostream& out, bool live = true);
+
+void simulate_numa(std::size_t nodes) noexcept;
+void bind_thread(std::size_t node) noexcept;
+int numa_node(const void* ptr) noexcept;
 
 }  // namespace Memory
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "numa.h"
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Memory::Numa {
+
+struct Topology {
+  std::vector<std::size_t> ids;
+  std::vector<std::vector<std::size_t>> cpus;
+  std::vector<std::size_t> cpu_node;
+};
+
+constexpr const std::size_t UNBOUND = std::numeric_limits<std::size_t>::max();
+
+static std::atomic<std::size_t> simulated{0};
+static thread_local std::size_t bound = UNBOUND;
+
+static std::vector<std::size_t> parse_list(const std::string& path) {
+  std::vector<std::size_t> result;
+  std::ifstream file(path);
+  std::string range;
+  while (std::getline(file, range, ',')) {
+    std::size_t first = 0, last = 0;
+    char dash = 0;
+    std::istringstream iss(range);
+    if (!(iss >> first)) continue;
+    last = (iss >> dash >> last && dash == '-') ? last : first;
+    for (std::size_t item = first; item <= last; ++item) {
+      result.push_back(item);
+    }
+  }
+  return result;
+}
+
+static Topology detect() {
+  Topology topology;
+  topology.ids = parse_list("/sys/devices/system/node/online");
+  for (const std::size_t id : topology.ids) {
+    topology.cpus.push_back(parse_list("/sys/devices/system/node/node" +
+                                       std::to_string(id) + "/cpulist"));
+    for (const std::size_t cpu : topology.cpus.back()) {
+      if (topology.cpu_node.size() <= cpu) topology.cpu_node.resize(cpu + 1);
+      topology.cpu_node[cpu] = topology.cpus.size() - 1;
+    }
+  }
+  return topology;
+}
+
+static const Topology& topology() {
+  static const Topology detected = detect();
+  return detected;
+}
+
+static std::size_t simulated_nodes() noexcept {
+  return simulated.load(std::memory_order_relaxed);
+}
+
+static bool physical(std::size_t node) noexcept {
+  return !simulated_nodes() && topology().ids.size() > 1 &&
+         node < topology().ids.size();
+}
+
+static void warn(const char* action, std::size_t node) noexcept {
+  std::cerr << "Memory: cannot " << action << " NUMA node "
+            << topology().ids[node] << ": " << std::strerror(errno)
+            << std::endl;
+}
+
+void simulate(std::size_t nodes) noexcept {
+  simulated.store(nodes, std::memory_order_relaxed);
+}
+
+[[nodiscard]] std::size_t nodes() noexcept {
+  if (const std::size_t count = simulated_nodes()) return count;
+  return std::max<std::size_t>(topology().ids.size(), 1);
+}
+
+[[nodiscard]] std::size_t current_node() noexcept {
+  if (bound != UNBOUND) return bound;
+
+  const int cpu = sched_getcpu();
+  if (cpu < 0) return 0;
+  if (const std::size_t count = simulated_nodes()) {
+    return static_cast<std::size_t>(cpu) % count;
+  }
+
+  const auto& cpu_node = topology().cpu_node;
+  return static_cast<std::size_t>(cpu) < cpu_node.size() ? cpu_node[cpu] : 0;
+}
+
+void bind_thread(std::size_t node) noexcept {
+  bound = node % nodes();
+  if (!physical(bound) || topology().cpus[bound].empty()) return;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const std::size_t cpu : topology().cpus[bound]) {
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set)) {
+    warn("pin the thread to", bound);
+  }
+}
+
+[[nodiscard]] std::byte* map(std::size_t size, std::size_t node) noexcept {
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) return nullptr;
+
+  // Bind before the first touch so every page is faulted in on the node.
+  if (physical(node)) {
+    constexpr std::size_t BITS = std::numeric_limits<unsigned long>::digits;
+    const std::size_t id = topology().ids[node];
+    std::vector<unsigned long> mask(id / BITS + 1);
+    mask[id / BITS] |= 1UL << (id % BITS);
+    // Without the binding pages land wherever they are first touched.
+    if (syscall(SYS_mbind, addr, size, MPOL_BIND, mask.data(),
+                mask.size() * BITS + 1, 0)) {
+      warn("bind the arena to", node);
+    }
+  }
+  return static_cast<std::byte*>(addr);
+}
+
+void unmap(std::byte* addr, std::size_t size) noexcept {
+  if (addr) munmap(addr, size);
+}
+
+}  // namespace Memory::Numa
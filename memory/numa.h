@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Memory::Numa {
+
+// Passed to map() for memory that is not bound to any node.
+constexpr const std::size_t ANY_NODE = SIZE_MAX;
+
+void simulate(std::size_t nodes) noexcept;
+
+[[nodiscard]] std::size_t nodes() noexcept;
+[[nodiscard]] std::size_t current_node() noexcept;
+
+void bind_thread(std::size_t node) noexcept;
+
+[[nodiscard]] std::byte* map(std::size_t size, std::size_t node) noexcept;
+void unmap(std::byte* addr, std::size_t size) noexcept;
+
+}  // namespace Memory::Numa
@@ -0,0 +1,187 @@
+#include "profiler.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Memory::Profiler {
+
+struct Site {
+  std::size_t live_bytes{0};
+  std::size_t live_count{0};
+  std::size_t total_bytes{0};
+  std::size_t total_count{0};
+};
+
+struct Sample {
+  Site* site;
+  double weight;
+  std::size_t bytes;
+  std::size_t count;
+};
+
+constexpr const int MAX_DEPTH = 64;
+constexpr const int SKIP_FRAMES = 2;
+
+std::atomic<std::size_t> sample_rate{0};
+
+static std::mutex lock;
+static std::size_t countdown = 0;
+static std::mt19937_64 engine{std::random_device{}()};
+static std::map<std::vector<void*>, Site> sites;
+static std::unordered_map<void*, Sample> live;
+
+static std::size_t current_rate() noexcept {
+  return sample_rate.load(std::memory_order_relaxed);
+}
+
+static std::size_t next_interval() {
+  std::exponential_distribution<double> distribution(1.0 / current_rate());
+  return static_cast<std::size_t>(distribution(engine)) + 1;
+}
+
+static std::string symbolize(void* frame) {
+  Dl_info info;
+  if (!dladdr(frame, &info)) {
+    char address[2 * sizeof(void*) + 3];
+    std::snprintf(address, sizeof(address), "%p", frame);
+    return address;
+  }
+
+  std::string name;
+  if (info.dli_sname) {
+    int status = 0;
+    char* demangled =
+        abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    name = status == 0 ? demangled : info.dli_sname;
+    std::free(demangled);
+  } else {
+    // Static functions and lambdas are not exported; print the offset into
+    // the module instead, which addr2line can resolve after the process ends.
+    const char* file = info.dli_fname ? info.dli_fname : "";
+    const char* slash = std::strrchr(file, '/');
+    char offset[2 * sizeof(void*) + 4];
+    std::snprintf(offset, sizeof(offset), "+0x%zx",
+                  static_cast<std::size_t>(static_cast<const char*>(frame) -
+                                           static_cast<const char*>(
+                                               info.dli_fbase)));
+    name = std::string(slash ? slash + 1 : file) + offset;
+  }
+  std::replace(name.begin(), name.end(), ';', ':');
+  return name;
+}
+
+void configure(std::size_t rate) {
+  std::lock_guard<std::mutex> guard(lock);
+  sample_rate.store(rate, std::memory_order_relaxed);
+  sites.clear();
+  live.clear();
+  if (rate) {
+    countdown = next_interval();
+  }
+}
+
+void on_alloc(void* ptr, std::size_t size) {
+  if (!ptr) return;
+  std::lock_guard<std::mutex> guard(lock);
+  // The profiler may have been disabled since the caller checked enabled().
+  if (!current_rate()) return;
+  if (size < countdown) {
+    countdown -= size;
+    return;
+  }
+  countdown = next_interval();
+
+  std::array<void*, MAX_DEPTH> frames;
+  const int depth = backtrace(frames.data(), MAX_DEPTH);
+  std::vector<void*> stack(frames.begin() + std::min(depth, SKIP_FRAMES),
+                           frames.begin() + depth);
+
+  // An allocation of `size` bytes is picked with probability
+  // 1 - exp(-size / rate), so each sample stands for 1 / p allocations.
+  const double probability =
+      -std::expm1(-static_cast<double>(size) / current_rate());
+  const Sample sample{&sites[std::move(stack)], 1.0 / probability,
+                      static_cast<std::size_t>(size / probability),
+                      static_cast<std::size_t>(std::lround(1.0 / probability))};
+
+  sample.site->live_bytes += sample.bytes;
+  sample.site->live_count += sample.count;
+  sample.site->total_bytes += sample.bytes;
+  sample.site->total_count += sample.count;
+  live[ptr] = sample;
+}
+
+void on_free(void* ptr) noexcept {
+  std::lock_guard<std::mutex> guard(lock);
+  auto item = live.find(ptr);
+  if (item == live.end()) return;
+  item->second.site->live_bytes -= item->second.bytes;
+  item->second.site->live_count -= item->second.count;
+  live.erase(item);
+}
+
+void on_resize(void* ptr, std::size_t size) noexcept {
+  std::lock_guard<std::mutex> guard(lock);
+  auto item = live.find(ptr);
+  if (item == live.end()) return;
+
+  // An in-place resize is not a new allocation: the sample keeps its weight
+  // and only its live bytes follow the new size, the totals stay untouched.
+  Sample& sample = item->second;
+  const auto bytes = static_cast<std::size_t>(size * sample.weight);
+  sample.site->live_bytes -= sample.bytes;
+  sample.site->live_bytes += bytes;
+  sample.bytes = bytes;
+}
+
+void on_move(void* from, void* to) noexcept {
+  std::lock_guard<std::mutex> guard(lock);
+  auto node = live.extract(from);
+  if (node) {
+    node.key() = to;
+    live.insert(std::move(node));
+  }
+}
+
+void on_reset() noexcept {
+  std::lock_guard<std::mutex> guard(lock);
+  for (auto& [stack, site] : sites) {
+    site.live_bytes = 0;
+    site.live_count = 0;
+  }
+  live.clear();
+}
+
+void report(std::ostream& out, bool live_only) {
+  std::lock_guard<std::mutex> guard(lock);
+  std::unordered_map<void*, std::string> names;
+  for (const auto& [stack, site] : sites) {
+    const std::size_t bytes = live_only ? site.live_bytes : site.total_bytes;
+    if (!bytes) continue;
+    for (auto frame = stack.rbegin(); frame != stack.rend(); ++frame) {
+      auto name = names.find(*frame);
+      if (name == names.end()) {
+        name = names.emplace(*frame, symbolize(*frame)).first;
+      }
+      out << name->second << (std::next(frame) == stack.rend() ? ' ' : ';');
+    }
+    out << bytes << '\n';
+  }
+}
+
+}  // namespace Memory::Profiler
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+
+namespace Memory::Profiler {
+
+extern std::atomic<std::size_t> sample_rate;
+
+[[nodiscard]] inline bool enabled() noexcept {
+  return sample_rate.load(std::memory_order_relaxed) != 0;
+}
+
+void configure(std::size_t rate);
+
+void on_alloc(void* ptr, std::size_t size);
+void on_free(void* ptr) noexcept;
+void on_resize(void* ptr, std::size_t size) noexcept;
+void on_move(void* from, void* to) noexcept;
+void on_reset() noexcept;
+
+void report(std::ostream& out, bool live_only);
+
+}  // namespace Memory::Profiler
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Memory::Snapshot {
+
+constexpr const char MAGIC[8] = {'M', 'E', 'M', 'S', 'N', 'A', 'P', '1'};
+
+enum Type : std::uint8_t { kChar = 0U, kInt, kDouble, kOther, kTypesAll };
+
+// Stored in Record::used; quarantined blocks only exist in checked builds.
+enum State : std::uint8_t { kFree = 0U, kUsed, kQuarantined };
+
+struct FileHeader {
+  char magic[8];
+  std::uint64_t heap_size;
+  std::uint64_t header_size;
+  std::uint64_t blocks;
+};
+
+struct Record {
+  std::uint64_t offset;
+  std::uint64_t size;
+  std::uint8_t used;
+  std::uint8_t type;
+  std::uint8_t reserved[6];
+};
+
+static_assert(sizeof(FileHeader) == 32, "snapshot header layout changed");
+static_assert(sizeof(Record) == 24, "snapshot record layout changed");
+
+}  // namespace Memory::Snapshot
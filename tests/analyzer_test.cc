@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "analyzer.h"
+#include "memory.h"
+
+namespace {
+
+constexpr std::size_t kHeapSize = 1 << 16;
+
+class AnalyzerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Memory::init(kHeapSize);
+    m_path = std::filesystem::temp_directory_path() / "analyzer_test.snap";
+  }
+
+  void TearDown() override { std::filesystem::remove(m_path); }
+
+  void Save(const Memory::Snapshot::FileHeader &header,
+            const std::vector<Memory::Snapshot::Record> &records) const {
+    std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(records.data()),
+               records.size() * sizeof(Memory::Snapshot::Record));
+  }
+
+  void Save(const Memory::Snapshot::FileHeader &header,
+            std::size_t records) const {
+    Save(header, std::vector<Memory::Snapshot::Record>(records));
+  }
+
+  static Memory::Snapshot::FileHeader Header(std::uint64_t blocks) {
+    Memory::Snapshot::FileHeader header{};
+    std::memcpy(header.magic, Memory::Snapshot::MAGIC, sizeof(header.magic));
+    header.heap_size = kHeapSize;
+    header.blocks = blocks;
+    return header;
+  }
+
+  std::filesystem::path m_path;
+};
+
+TEST_F(AnalyzerTest, LoadsSnapshotOfTheHeap) {
+  void *numbers = Memory::malloc(4 * sizeof(int));
+  ASSERT_NE(Memory::malloc(200), nullptr);
+  ASSERT_TRUE(Memory::write(numbers, std::vector<int>{1, 2, 3, 4}));
+  ASSERT_TRUE(Memory::snapshot(m_path));
+
+  Analyzer analyzer(64);
+  ASSERT_TRUE(analyzer.Load(m_path));
+
+  std::ostringstream summary, map, types;
+  analyzer.Summary(summary);
+  analyzer.FragmentationMap(map);
+  analyzer.TypeBreakdown(types);
+  EXPECT_NE(summary.str().find("Heap size:       65536\n"), std::string::npos);
+  EXPECT_NE(summary.str().find("Blocks:          3 (2 used, 1 free)\n"),
+            std::string::npos);
+  const std::string row = "0x0000000000 ";
+  ASSERT_NE(map.str().find(row), std::string::npos);
+  const std::size_t cells = map.str().find(row) + row.size();
+  ASSERT_LT(cells + 64, map.str().size());
+  EXPECT_NE(map.str()[cells], '.');
+  EXPECT_EQ(map.str().substr(cells + 1, 64), std::string(63, '.') + '\n');
+  EXPECT_NE(types.str().find("int           1 blocks"), std::string::npos);
+  EXPECT_NE(types.str().find("char           1 blocks"), std::string::npos);
+}
+
+TEST_F(AnalyzerTest, RejectsMissingFileAndBadMagic) {
+  Analyzer analyzer;
+  EXPECT_FALSE(analyzer.Load(m_path));
+
+  auto header = Header(1);
+  header.magic[0] = 'X';
+  Save(header, 1);
+  EXPECT_FALSE(analyzer.Load(m_path));
+}
+
+TEST_F(AnalyzerTest, RejectsBlockCountThatDoesNotMatchTheFile) {
+  Analyzer analyzer;
+  Save(Header(3), 2);
+  EXPECT_FALSE(analyzer.Load(m_path));
+
+  // 2^61 records of 24 bytes wrap around to zero bytes of payload.
+  Save(Header(1ULL << 61), 0);
+  EXPECT_FALSE(analyzer.Load(m_path));
+
+  Save(Header(2), 2);
+  EXPECT_TRUE(analyzer.Load(m_path));
+}
+
+TEST_F(AnalyzerTest, CountsQuarantinedBlocksSeparately) {
+  auto header = Header(3);
+  header.header_size = 16;
+  Save(header, {{0, 100, Memory::Snapshot::kUsed, Memory::Snapshot::kInt, {}},
+                {116, 200, Memory::Snapshot::kQuarantined,
+                 Memory::Snapshot::kInt, {}},
+                {332, kHeapSize - 348, Memory::Snapshot::kFree,
+                 Memory::Snapshot::kChar, {}}});
+
+  Analyzer analyzer;
+  ASSERT_TRUE(analyzer.Load(m_path));
+  std::ostringstream summary, types, map, histogram;
+  analyzer.Summary(summary);
+  analyzer.TypeBreakdown(types);
+  analyzer.FragmentationMap(map);
+  analyzer.SizeHistogram(histogram);
+  EXPECT_NE(summary.str().find("3 (1 used, 1 free, 1 quarantined)\n"),
+            std::string::npos);
+  EXPECT_NE(summary.str().find("Used bytes:      100\n"), std::string::npos);
+  EXPECT_NE(summary.str().find("Quarantined:     200\n"), std::string::npos);
+  EXPECT_NE(types.str().find("int           1 blocks"), std::string::npos);
+  EXPECT_NE(types.str().find("100.00%"), std::string::npos);
+
+  // 128 bytes per cell: the second cell lies inside the quarantined block.
+  EXPECT_NE(map.str().find("0x0000000000 #q"), std::string::npos);
+  EXPECT_NE(histogram.str().find("quarantined bytes"), std::string::npos);
+  EXPECT_NE(histogram.str().find(
+                "[        128,         256)           0               0"
+                "           0               0            1               "
+                "200\n"),
+            std::string::npos);
+}
+
+}  // namespace
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include "memory.h"
+
+namespace {
+
+constexpr std::size_t kHeapSize = 1 << 16;
+
+class CheckedDeathTest : public ::testing::Test {
+ protected:
+  void SetUp() override { Memory::init(kHeapSize); }
+};
+
+TEST_F(CheckedDeathTest, DoubleFreeAborts) {
+  void *ptr = Memory::malloc(32);
+  ASSERT_NE(ptr, nullptr);
+  Memory::free(ptr);
+  EXPECT_DEATH(Memory::free(ptr), "double free or use of a freed block in free");
+}
+
+TEST_F(CheckedDeathTest, ForeignPointerAborts) {
+  int outside = 0;
+  EXPECT_DEATH(Memory::free(&outside), "pointer outside of the heap in free");
+  EXPECT_DEATH(Memory::realloc(&outside, 16),
+               "pointer outside of the heap in realloc");
+}
+
+TEST_F(CheckedDeathTest, OverwrittenCanaryAborts) {
+  auto *ptr = static_cast<unsigned char *>(Memory::malloc(32));
+  ASSERT_NE(ptr, nullptr);
+  ptr[32] = 0;
+  EXPECT_DEATH(Memory::free(ptr), "write past the end of the block in free");
+}
+
+TEST_F(CheckedDeathTest, WriteToQuarantinedBlockAborts) {
+  auto *ptr = static_cast<unsigned char *>(Memory::malloc(32));
+  ASSERT_NE(ptr, nullptr);
+  Memory::free(ptr);
+  ptr[0] = 0;
+  EXPECT_DEATH(Memory::defragmentation(),
+               "write to a freed block in defragmentation");
+}
+
+TEST_F(CheckedDeathTest, OversizedRequestsFailWithoutWrappingAround) {
+  EXPECT_EQ(Memory::malloc(SIZE_MAX), nullptr);
+  EXPECT_EQ(Memory::malloc_onlyfree(SIZE_MAX - 1), nullptr);
+
+  void *ptr = Memory::malloc(32);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(Memory::realloc(ptr, SIZE_MAX), nullptr);
+  EXPECT_EQ(Memory::realloc_onlyfree(ptr, SIZE_MAX), nullptr);
+  EXPECT_TRUE(Memory::verify());
+  Memory::free(ptr);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(CheckedDeathTest, QuarantinedBlocksAreNotCountedAsUsed) {
+  void *ptr = Memory::malloc(32);
+  ASSERT_NE(ptr, nullptr);
+  Memory::free(ptr);
+
+  const Memory::Stats stats = Memory::stats();
+  EXPECT_EQ(stats.used_blocks, 0U);
+  EXPECT_EQ(stats.quarantined_blocks, 1U);
+  EXPECT_GE(stats.quarantined_bytes, 32U);
+
+  Memory::defragmentation();
+  EXPECT_EQ(Memory::stats().quarantined_blocks, 0U);
+}
+
+}  // namespace
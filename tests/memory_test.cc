@@ -0,0 +1,367 @@
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <sstream>
+#include <thread>
+
+#include "memory.h"
+#include "snapshot.h"
+
+namespace {
+
+constexpr std::size_t kHeapSize = 1 << 16;
+
+// Runs `func` on a thread pinned to `cpu`, unless the thread cannot be pinned.
+template <typename F>
+bool OnCpu(int cpu, F func) {
+  bool pinned = false;
+  std::thread([cpu, &func, &pinned]() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pinned = !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (pinned) func();
+  }).join();
+  return pinned;
+}
+
+std::vector<int> AllowedCpus() {
+  cpu_set_t set;
+  std::vector<int> cpus;
+  if (sched_getaffinity(0, sizeof(set), &set)) return cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+class MemoryTest : public ::testing::Test {
+ protected:
+  void SetUp() override { Memory::init(kHeapSize); }
+
+  void TearDown() override { Memory::simulate_numa(0); }
+};
+
+TEST_F(MemoryTest, InitCreatesOneFreeBlock) {
+  const Memory::Stats stats = Memory::stats();
+  EXPECT_EQ(stats.heap_size, kHeapSize);
+  EXPECT_EQ(stats.used_blocks, 0U);
+  EXPECT_EQ(stats.free_blocks, 1U);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, InitReportsHeapThatIsTooSmall) {
+  EXPECT_FALSE(Memory::init(10));
+  EXPECT_TRUE(Memory::init(kHeapSize));
+  EXPECT_EQ(Memory::stats().heap_size, kHeapSize);
+}
+
+TEST_F(MemoryTest, MallocReturnsBlockInsideHeap) {
+  void *ptr = Memory::malloc(100);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(Memory::numa_node(ptr), 0);
+  EXPECT_EQ(Memory::stats().used_blocks, 1U);
+  EXPECT_GE(Memory::stats().used_bytes, 100U);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, MallocFailsWhenHeapIsExhausted) {
+  EXPECT_EQ(Memory::malloc(kHeapSize), nullptr);
+  EXPECT_EQ(Memory::malloc_onlyfree(kHeapSize), nullptr);
+}
+
+TEST_F(MemoryTest, CallocZeroesMemory) {
+  auto *dirty = static_cast<unsigned char *>(Memory::malloc(64));
+  ASSERT_NE(dirty, nullptr);
+  std::memset(dirty, 0xAB, 64);
+  Memory::free(dirty);
+
+  auto *clean = static_cast<unsigned char *>(Memory::calloc(16, 4));
+  ASSERT_NE(clean, nullptr);
+  for (std::size_t i = 0; i < 64; ++i) {
+    EXPECT_EQ(clean[i], 0U);
+  }
+}
+
+TEST_F(MemoryTest, ReallocKeepsContents) {
+  auto *ptr = static_cast<char *>(Memory::malloc(16));
+  void *blocker = Memory::malloc(16);
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_NE(blocker, nullptr);
+  std::memcpy(ptr, "0123456789abcdef", 16);
+
+  auto *moved = static_cast<char *>(Memory::realloc(ptr, 4096));
+  ASSERT_NE(moved, nullptr);
+  EXPECT_NE(moved, ptr);
+  EXPECT_EQ(std::memcmp(moved, "0123456789abcdef", 16), 0);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, ReallocShrinksInPlace) {
+  void *ptr = Memory::malloc(1024);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(Memory::realloc(ptr, 100), ptr);
+  EXPECT_EQ(Memory::stats().free_blocks, 2U);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, FreeMergesNeighbours) {
+  void *first = Memory::malloc(100);
+  void *second = Memory::malloc(100);
+  void *third = Memory::malloc(100);
+  Memory::free(first);
+  Memory::free(third);
+  Memory::free(second);
+  Memory::defragmentation();
+
+  const Memory::Stats stats = Memory::stats();
+  EXPECT_EQ(stats.used_blocks, 0U);
+  EXPECT_EQ(stats.free_blocks, 1U);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, FreeIntoFreePredecessorListsItOnce) {
+  void *first = Memory::malloc_onlyfree(100);
+  void *second = Memory::malloc_onlyfree(100);
+  void *third = Memory::malloc_onlyfree(100);
+  ASSERT_NE(third, nullptr);
+  Memory::free_onlyfree(first);
+  Memory::free_onlyfree(second);
+  Memory::defragmentation();
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, MallocOnlyFreeReusesFreedBlock) {
+  void *first = Memory::malloc_onlyfree(100);
+  void *second = Memory::malloc_onlyfree(100);
+  ASSERT_NE(second, nullptr);
+  Memory::free_onlyfree(first);
+  Memory::defragmentation();
+  EXPECT_NE(Memory::malloc_onlyfree(100), nullptr);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, WriteStoresTypedData) {
+  void *ptr = Memory::malloc(sizeof(int) * 4);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_TRUE(Memory::write(ptr, std::vector<int>{1, 2, 3, 4}));
+  EXPECT_EQ(static_cast<int *>(ptr)[3], 4);
+}
+
+TEST_F(MemoryTest, WriteRejectsOversizedData) {
+  void *ptr = Memory::malloc(sizeof(int));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_FALSE(Memory::write(ptr, std::vector<double>(64, 1.0)));
+
+  int outside = 0;
+  EXPECT_FALSE(Memory::write(&outside, std::vector<int>{1}));
+}
+
+TEST_F(MemoryTest, WriteRejectsDataRunningPastTheBlock) {
+  auto *ptr = static_cast<char *>(Memory::malloc(32));
+  ASSERT_NE(Memory::malloc(32), nullptr);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_FALSE(Memory::write(ptr + 16, std::vector<char>(32, 'x')));
+  EXPECT_TRUE(Memory::write(ptr + 16, std::vector<char>(16, 'x')));
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, DefragmentationCompactsFreeSpace) {
+  std::vector<void *> ptrs;
+  for (std::size_t i = 0; i < 10; ++i) {
+    ptrs.push_back(Memory::malloc(200));
+  }
+  for (std::size_t i = 0; i < ptrs.size(); i += 2) {
+    Memory::free(ptrs[i]);
+  }
+  Memory::defragmentation();
+
+  const Memory::Stats stats = Memory::stats();
+  EXPECT_EQ(stats.used_blocks, 5U);
+  EXPECT_EQ(stats.free_blocks, 1U);
+  EXPECT_EQ(stats.largest_free, stats.free_bytes);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, DefragmentationOfFullHeap) {
+  const std::size_t half = Memory::stats().largest_free / 2;
+  void *first = Memory::malloc(half);
+  ASSERT_NE(first, nullptr);
+  Memory::free(first);
+  while (Memory::malloc(half / 4)) {
+  }
+  Memory::defragmentation();
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, SnapshotStoresEveryBlock) {
+  Memory::malloc(100);
+  Memory::malloc(200);
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "memory_test.snap";
+  ASSERT_TRUE(Memory::snapshot(path));
+
+  std::ifstream file(path, std::ios::binary);
+  Memory::Snapshot::FileHeader header{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  EXPECT_EQ(std::memcmp(header.magic, Memory::Snapshot::MAGIC, 8), 0);
+  EXPECT_EQ(header.heap_size, kHeapSize);
+  EXPECT_EQ(header.blocks, 3U);
+  EXPECT_EQ(std::filesystem::file_size(path),
+            sizeof(header) + 3 * sizeof(Memory::Snapshot::Record));
+  std::filesystem::remove(path);
+}
+
+TEST_F(MemoryTest, SnapshotForgetsTypeOfReusedBlock) {
+  void *first = Memory::malloc(8 * sizeof(double));
+  ASSERT_NE(Memory::malloc(16), nullptr);
+  ASSERT_TRUE(Memory::write(first, std::vector<double>(8, 1.0)));
+  Memory::free(first);
+  void *second = Memory::malloc(8 * sizeof(double));
+  ASSERT_NE(second, nullptr);
+
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "memory_test.snap";
+  ASSERT_TRUE(Memory::snapshot(path));
+  std::ifstream file(path, std::ios::binary);
+  Memory::Snapshot::FileHeader header{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  Memory::Snapshot::Record record{};
+  for (std::uint64_t i = 0; i < header.blocks; ++i) {
+    file.read(reinterpret_cast<char *>(&record), sizeof(record));
+    // Quarantined blocks in checked builds still describe the freed data.
+    if (record.used == Memory::Snapshot::kUsed) {
+      EXPECT_EQ(record.type, Memory::Snapshot::kChar);
+    }
+  }
+  std::filesystem::remove(path);
+}
+
+TEST_F(MemoryTest, SimulatedNumaRoutesThreadsToTheirNode) {
+  Memory::simulate_numa(2);
+  Memory::init(kHeapSize, true);
+
+  int nodes[2] = {-1, -1};
+  std::vector<std::thread> threads;
+  for (int node = 0; node < 2; ++node) {
+    threads.emplace_back([node, &nodes]() {
+      Memory::bind_thread(node);
+      nodes[node] = Memory::numa_node(Memory::malloc(100));
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(nodes[0], 0);
+  EXPECT_EQ(nodes[1], 1);
+  EXPECT_EQ(Memory::stats().heap_size, kHeapSize);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, SimulatedNumaRoutesThreadsByCurrentCpu) {
+  Memory::simulate_numa(2);
+  Memory::init(kHeapSize, true);
+
+  // A simulated topology maps CPU n to node n % 2.
+  bool seen[2] = {false, false};
+  for (const int cpu : AllowedCpus()) {
+    if (seen[cpu % 2]) continue;
+    int node = -1;
+    ASSERT_TRUE(OnCpu(cpu, [&node]() {
+      node = Memory::numa_node(Memory::malloc(100));
+    }));
+    EXPECT_EQ(node, cpu % 2);
+    seen[cpu % 2] = true;
+  }
+  EXPECT_TRUE(seen[0] || seen[1]);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, SimulatedNumaSpillsToOtherNodeWhenLocalIsFull) {
+  Memory::simulate_numa(2);
+  Memory::init(kHeapSize, true);
+  const std::vector<int> cpus = AllowedCpus();
+  ASSERT_FALSE(cpus.empty());
+
+  int first = -1, second = -1;
+  void *whole = nullptr;
+  ASSERT_TRUE(OnCpu(cpus.front(), [&]() {
+    // Each arena holds half of the heap, so no block can be larger than that.
+    whole = Memory::malloc(kHeapSize * 3 / 4);
+    first = Memory::numa_node(Memory::malloc(kHeapSize / 4));
+    second = Memory::numa_node(Memory::malloc(kHeapSize / 4));
+  }));
+  EXPECT_EQ(whole, nullptr);
+  EXPECT_EQ(first, cpus.front() % 2);
+  EXPECT_EQ(second, 1 - cpus.front() % 2);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, SharedHeapIsNotSplitAcrossNodes) {
+  Memory::simulate_numa(2);
+  Memory::init(kHeapSize);
+
+  void *whole = Memory::malloc(kHeapSize * 3 / 4);
+  ASSERT_NE(whole, nullptr);
+  EXPECT_EQ(Memory::numa_node(whole), 0);
+  EXPECT_EQ(Memory::stats().heap_size, kHeapSize);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, DetectedTopologyServesAllocations) {
+  Memory::simulate_numa(0);
+  Memory::init(kHeapSize, true);
+
+  void *ptr = Memory::malloc(100);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_GE(Memory::numa_node(ptr), 0);
+  EXPECT_EQ(Memory::stats().heap_size, kHeapSize);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_F(MemoryTest, ProfilerTracksLiveAllocations) {
+  Memory::set_sample_rate(1);
+  void *ptr = Memory::malloc(100);
+
+  std::ostringstream live;
+  Memory::dump_profile(live);
+  EXPECT_NE(live.str().find(" 100\n"), std::string::npos);
+
+  Memory::free(ptr);
+  std::ostringstream freed, total;
+  Memory::dump_profile(freed);
+  Memory::dump_profile(total, false);
+  EXPECT_TRUE(freed.str().empty());
+  EXPECT_FALSE(total.str().empty());
+  Memory::set_sample_rate(0);
+}
+
+TEST_F(MemoryTest, ProfilerNamesUnexportedFramesByModuleOffset) {
+  Memory::set_sample_rate(1);
+  void *ptr = Memory::malloc(100);
+
+  // TestBody of a class in an anonymous namespace has no exported symbol.
+  std::ostringstream live;
+  Memory::dump_profile(live);
+  EXPECT_NE(live.str().find("MemoryTests+0x"), std::string::npos);
+  Memory::free(ptr);
+  Memory::set_sample_rate(0);
+}
+
+TEST_F(MemoryTest, ProfilerDoesNotCountInPlaceReallocAsAllocation) {
+  Memory::set_sample_rate(1);
+  void *ptr = Memory::malloc(100);
+  ASSERT_EQ(Memory::realloc(ptr, 50), ptr);
+  ASSERT_EQ(Memory::realloc(ptr, 80), ptr);
+
+  std::ostringstream live, total;
+  Memory::dump_profile(live);
+  Memory::dump_profile(total, false);
+  EXPECT_NE(live.str().find(" 80\n"), std::string::npos);
+  EXPECT_NE(total.str().find(" 100\n"), std::string::npos);
+  Memory::set_sample_rate(0);
+}
+
+}  // namespace
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <random>
+
+#include "memory.h"
+#include "snapshot.h"
+
+namespace {
+
+constexpr std::size_t kHeapSize = 1 << 18;
+constexpr std::size_t kOperations = 3000;
+constexpr std::size_t kMaxBlock = 2048;
+
+struct Allocation {
+  unsigned char *ptr;
+  std::size_t size;
+  unsigned char tag;
+};
+
+class PropertyTest : public ::testing::TestWithParam<unsigned> {
+ protected:
+  void SetUp() override {
+    Memory::init(kHeapSize);
+    m_random.seed(GetParam());
+  }
+
+  std::size_t Random(std::size_t limit) { return m_random() % limit; }
+
+  void Fill(const Allocation &allocation) {
+    std::memset(allocation.ptr, allocation.tag, allocation.size);
+  }
+
+  static bool Intact(const Allocation &allocation, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      if (allocation.ptr[i] != allocation.tag) return false;
+    }
+    return true;
+  }
+
+  void Allocate() {
+    const std::size_t size = 1 + Random(kMaxBlock);
+    void *ptr = nullptr;
+    switch (Random(4)) {
+      case 0:
+        ptr = Memory::malloc(size);
+        break;
+      case 1:
+        ptr = Memory::malloc_onlyfree(size);
+        break;
+      case 2:
+        ptr = Memory::calloc(size, 1);
+        break;
+      default:
+        ptr = Memory::calloc_onlyfree(1, size);
+        break;
+    }
+    if (!ptr) return;
+    m_live.push_back({static_cast<unsigned char *>(ptr), size,
+                      static_cast<unsigned char>(Random(256))});
+    Fill(m_live.back());
+  }
+
+  void Release() {
+    if (m_live.empty()) return;
+    const std::size_t index = Random(m_live.size());
+    ASSERT_TRUE(Intact(m_live[index], m_live[index].size));
+    if (Random(2)) {
+      Memory::free(m_live[index].ptr);
+    } else {
+      Memory::free_onlyfree(m_live[index].ptr);
+    }
+    m_live.erase(m_live.begin() + index);
+  }
+
+  void Resize() {
+    if (m_live.empty()) return;
+    Allocation &allocation = m_live[Random(m_live.size())];
+    const std::size_t size = 1 + Random(kMaxBlock);
+    void *ptr = Random(2) ? Memory::realloc(allocation.ptr, size)
+                          : Memory::realloc_onlyfree(allocation.ptr, size);
+    if (!ptr) return;
+    allocation.ptr = static_cast<unsigned char *>(ptr);
+    ASSERT_TRUE(Intact(allocation, std::min(allocation.size, size)));
+    allocation.size = size;
+    Fill(allocation);
+  }
+
+  // Offsets of the contents of every used block from the start of the heap,
+  // in address order, read back from a heap snapshot.
+  std::vector<std::size_t> UsedOffsets() const {
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() /
+        ("property_test_" + std::to_string(GetParam()) + ".snap");
+    std::vector<std::size_t> offsets;
+    if (!Memory::snapshot(path)) return offsets;
+
+    std::ifstream file(path, std::ios::binary);
+    Memory::Snapshot::FileHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    Memory::Snapshot::Record record{};
+    for (std::uint64_t i = 0; i < header.blocks; ++i) {
+      file.read(reinterpret_cast<char *>(&record), sizeof(record));
+      if (record.used == Memory::Snapshot::kUsed) {
+        offsets.push_back(record.offset + header.header_size);
+      }
+    }
+    std::filesystem::remove(path);
+    return offsets;
+  }
+
+  // Defragments the heap and follows every live block to its new address.
+  void Defragment() {
+    std::sort(m_live.begin(), m_live.end(),
+              [](const Allocation &lhs, const Allocation &rhs) {
+                return lhs.ptr < rhs.ptr;
+              });
+    const std::vector<std::size_t> before = UsedOffsets();
+    ASSERT_EQ(before.size(), m_live.size());
+    if (m_live.empty()) {
+      Memory::defragmentation();
+      return;
+    }
+    unsigned char *const heap = m_live.front().ptr - before.front();
+    for (std::size_t i = 0; i < m_live.size(); ++i) {
+      ASSERT_EQ(m_live[i].ptr, heap + before[i]);
+    }
+
+    const Memory::Stats old = Memory::stats();
+    Memory::defragmentation();
+    const Memory::Stats stats = Memory::stats();
+    ASSERT_EQ(stats.used_blocks, old.used_blocks);
+    ASSERT_EQ(stats.used_bytes, old.used_bytes);
+    ASSERT_LE(stats.free_blocks, 1U);
+    ASSERT_EQ(stats.largest_free, stats.free_bytes);
+
+    // Defragmentation keeps the order of the blocks, only closing the gaps.
+    const std::vector<std::size_t> after = UsedOffsets();
+    ASSERT_EQ(after.size(), m_live.size());
+    for (std::size_t i = 0; i < m_live.size(); ++i) {
+      ASSERT_LE(after[i], before[i]);
+      m_live[i].ptr = heap + after[i];
+      ASSERT_TRUE(Intact(m_live[i], m_live[i].size));
+    }
+  }
+
+  void Check() {
+    ASSERT_TRUE(Memory::verify());
+    const Memory::Stats stats = Memory::stats();
+    std::size_t requested = 0;
+    for (const auto &allocation : m_live) {
+      requested += allocation.size;
+    }
+    ASSERT_GE(stats.used_blocks, m_live.size());
+    ASSERT_GE(stats.used_bytes, requested);
+    ASSERT_LE(stats.largest_free, stats.free_bytes);
+  }
+
+  std::mt19937 m_random;
+  std::vector<Allocation> m_live;
+};
+
+TEST_P(PropertyTest, RandomOperationsKeepHeapConsistent) {
+  for (std::size_t i = 0; i < kOperations; ++i) {
+    switch (Random(3)) {
+      case 0:
+        Allocate();
+        break;
+      case 1:
+        Release();
+        break;
+      default:
+        Resize();
+        break;
+    }
+    Check();
+    if (HasFatalFailure()) return;
+  }
+
+  while (!m_live.empty()) {
+    Release();
+  }
+  Memory::defragmentation();
+  const Memory::Stats stats = Memory::stats();
+  EXPECT_EQ(stats.used_blocks, 0U);
+  EXPECT_EQ(stats.free_blocks, 1U);
+  EXPECT_TRUE(Memory::verify());
+}
+
+TEST_P(PropertyTest, DefragmentationKeepsHeapConsistent) {
+  for (std::size_t i = 0; i < kOperations; ++i) {
+    if (Random(50) == 0) {
+      Defragment();
+    } else if (Random(2)) {
+      Allocate();
+    } else {
+      Release();
+    }
+    Check();
+    if (HasFatalFailure()) return;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Seeds, PropertyTest, ::testing::Range(1U, 17U));
+
+}  // namespace